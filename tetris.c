@@ -1,14 +1,33 @@
+#define _GNU_SOURCE // memfd_create (anel mágico da fila)
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 // -----------------------------------------------------------------
 // 1. DEFINIÇÕES E ESTRUTURAS
 // -----------------------------------------------------------------
 
-#define MAX_FILA 5
+// Tamanho padrão da fila; pode ser trocado na linha de comando
+// (./tetris 100000 para uma prévia profunda).
+#define TAMANHO_FILA_PADRAO 5
+#define LIMITE_FILA (1 << 28)          // Maior tamanho aceito
+#define BYTES_PAGINA_GRANDE (2 << 20)  // Huge page de 2 MB (Linux)
 #define MAX_PILHA 3
 
+#define TIPOS_PECA "IOTLSJZ"
+#define NUM_TIPOS 7
+
 /**
  * @brief Estrutura da Peca
  */
@@ -21,10 +40,13 @@ typedef struct {
  * @brief Estrutura da Fila Circular
  */
 typedef struct {
-    Peca itens[MAX_FILA];
+    Peca *itens;    // Alocado por inicializarFila() (heap ou anel mágico)
     int front; 
     int rear;  
     int count; 
+    int tamanho;    // Peças que a fila mantém (escolhido na linha de comando)
+    int capacidade; // Potência de 2 >= tamanho: índices usam & (capacidade - 1)
+    int espelhada;  // 1 = anel mágico: itens[capacidade + i] é itens[i]
 } FilaCircular;
 
 /**
@@ -36,42 +58,231 @@ typedef struct {
 } PilhaLinear;
 
 /**
- * @brief Estrutura para salvar o estado do jogo (para o UNDO)
- * Contém cópias completas da fila, da pilha e do contador de ID.
+ * @brief Estatísticas da partida
+ * Contadores simples atualizados pelas ações (sem custo extra no laço).
+ */
+typedef struct {
+    int pecasJogadas;   // Da fila (1) ou da reserva (3)
+    int reservasFeitas;
+    int reservasUsadas;
+    int trocasTopoFrente;
+    int trocas3x3;
+    int frequencia[NUM_TIPOS]; // Peças jogadas por tipo, na ordem de TIPOS_PECA
+} Estatisticas;
+
+/**
+ * @brief Estado completo do jogo
+ * Fila, pilha, contador de ID e estatísticas. A especulação aberta
+ * sobre este estado (se houver) fica junto, para que as ações
+ * registrem o que sobrescrevem e o Desfazer possa voltar.
  */
 typedef struct {
     FilaCircular fila;
     PilhaLinear pilha;
     int proximoId; // Essencial para o Undo funcionar corretamente
+    Estatisticas stats;
+    struct Especulacao *especulacao; // NULL = nenhuma especulação aberta
 } EstadoJogo;
 
+#define JANELA_FILA 10 // Peças da fila mostradas na tela (a partir da frente)
+
+/**
+ * @brief O que está na tela: a frente da fila e a pilha.
+ * Comparar duas visões custa no máximo JANELA_FILA peças,
+ * qualquer que seja o tamanho da fila.
+ */
+typedef struct {
+    int countFila;
+    Peca frenteFila[JANELA_FILA];
+    PilhaLinear pilha;
+} VisaoEstado;
+
+#define MAX_ESPECULACAO 8       // Níveis de especulação aninhados
+#define MAX_LOG_ESCRITAS 256    // Slots registrados somando todos os níveis
+#define MAX_ESCRITAS_POR_ACAO 6 // Pior caso: troca 3x3 (3 na fila + 3 na pilha)
+
+// Uma ação por nível (como no laço principal) sempre cabe no log
+_Static_assert(MAX_ESPECULACAO * MAX_ESCRITAS_POR_ACAO <= MAX_LOG_ESCRITAS,
+               "MAX_LOG_ESCRITAS pequeno demais para MAX_ESPECULACAO niveis");
+
+/**
+ * @brief Uma escrita em slot de fila/pilha (endereço + valor antigo)
+ */
+typedef struct {
+    Peca *slot;
+    Peca antigo;
+} EscritaSlot;
+
+/**
+ * @brief Ponto de retorno de um nível de especulação.
+ * Guarda só os campos escalares; os slots alterados vão para o log.
+ */
+typedef struct {
+    int frontFila, rearFila, countFila;
+    int topoPilha;
+    int proximoId;
+    Estatisticas stats;
+    int inicioLog; // Tamanho do log quando o nível começou
+} Checkpoint;
+
+/**
+ * @brief Pilha de níveis de especulação + log de escritas (undo log)
+ * Cada Especulacao acompanha um único estado; para especular sobre
+ * dois estados (ex: dica e jogo real) use uma Especulacao para cada.
+ */
+typedef struct Especulacao {
+    EstadoJogo *estado; // Estado sob especulação (NULL se nenhum nível aberto)
+    Checkpoint niveis[MAX_ESPECULACAO];
+    int nivel; // 0 = nenhuma especulação aberta
+    EscritaSlot log[MAX_LOG_ESCRITAS];
+    int tamanhoLog;
+} Especulacao;
+
+#define NOME_PAINEL "/tetris_estado" // Memória compartilhada dos espectadores
+
+/**
+ * @brief Região compartilhada lida pelos espectadores (tetrisespectador.c).
+ * Protegida por seqlock: o jogo nunca espera pelos leitores.
+ * 'sequencia' ímpar = escrita em andamento.
+ * Publica só a visão (frente da fila + pilha), de tamanho fixo,
+ * qualquer que seja o tamanho da fila.
+ * 'pidJogo' permite notar um jogo que morreu sem fechar o painel.
+ */
+typedef struct {
+    atomic_uint sequencia;
+    atomic_int ativo;    // 0 quando o jogo termina
+    pid_t pidJogo;       // Processo que publica
+    int tamanhoPainel;   // sizeof(PainelCompartilhado): o espectador confere o layout
+    VisaoEstado visao;
+    int proximoId;
+    Estatisticas stats;
+} PainelCompartilhado;
+
+// Semente da sequência de peças (definida uma vez no início do jogo)
+unsigned int g_semente = 0;
+
+// Painel aberto por esta partida (para fechá-lo ao receber Ctrl+C / SIGTERM)
+PainelCompartilhado *g_painel = NULL;
+
+
 
 // -----------------------------------------------------------------
 // 2. FUNÇÕES DAS ESTRUTURAS (FILA E PILHA)
 // -----------------------------------------------------------------
 
 // --- Funções da Fila ---
-void inicializarFila(FilaCircular *fila) {
+
+/**
+ * @brief Anel mágico: mapeia as mesmas páginas duas vezes, lado a lado.
+ * Lendo a partir de qualquer índice < capacidade, as próximas
+ * 'capacidade' peças ficam contíguas, sem volta para o início.
+ * 'bytes' deve ser múltiplo do tamanho de página.
+ * As páginas são MAP_SHARED: um fork() depois daqui compartilharia a fila.
+ * Retorna NULL se o sistema não permitir (a fila usa o heap).
+ */
+Peca *criarAnelEspelhado(size_t bytes) {
+#ifdef MFD_CLOEXEC
+    int fd = memfd_create("tetris_fila", MFD_CLOEXEC);
+    if (fd == -1) return NULL;
+    if (ftruncate(fd, bytes) == -1) {
+        close(fd);
+        return NULL;
+    }
+
+    // Reserva 2x o espaço e sobrepõe as duas metades com o mesmo arquivo
+    char *base = mmap(NULL, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * bytes);
+        close(fd);
+        return NULL;
+    }
+    close(fd); // Os mapeamentos mantêm o arquivo vivo
+    return (Peca *)base;
+#else
+    (void)bytes;
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Aloca e inicializa a fila para 'tamanho' peças.
+ * O buffer tem capacidade arredondada para potência de 2, assim o
+ * avanço circular é um AND em vez de uma divisão. Filas grandes ficam
+ * alinhadas a 2 MB e pedem huge pages ao kernel; as médias (múltiplas
+ * de uma página) usam o anel mágico.
+ * Retorna 0 se faltar memória.
+ */
+int inicializarFila(FilaCircular *fila, int tamanho) {
+    int capacidade = 1;
+    while (capacidade < tamanho) capacidade *= 2;
+    size_t bytes = (size_t)capacidade * sizeof(Peca);
+    long pagina = sysconf(_SC_PAGESIZE);
+
+    fila->espelhada = 0;
+    if (bytes >= BYTES_PAGINA_GRANDE) {
+        // bytes é potência de 2, então já é múltiplo do alinhamento
+        fila->itens = aligned_alloc(BYTES_PAGINA_GRANDE, bytes);
+#ifdef MADV_HUGEPAGE
+        if (fila->itens != NULL) madvise(fila->itens, bytes, MADV_HUGEPAGE);
+#endif
+    } else if (pagina > 0 && bytes % pagina == 0 &&
+               (fila->itens = criarAnelEspelhado(bytes)) != NULL) {
+        fila->espelhada = 1;
+    } else {
+        fila->itens = malloc(bytes);
+    }
+    if (fila->itens == NULL) return 0;
+
     fila->front = 0;
     fila->rear = 0;
     fila->count = 0;
+    fila->tamanho = tamanho;
+    fila->capacidade = capacidade;
+    return 1;
+}
+void liberarFila(FilaCircular *fila) {
+    if (fila->espelhada) {
+        munmap(fila->itens, 2 * (size_t)fila->capacidade * sizeof(Peca));
+    } else {
+        free(fila->itens);
+    }
+    fila->itens = NULL;
 }
 int filaEstaVazia(FilaCircular *fila) { return (fila->count == 0); }
-int filaEstaCheia(FilaCircular *fila) { return (fila->count == MAX_FILA); }
+int filaEstaCheia(FilaCircular *fila) { return (fila->count == fila->tamanho); }
 
 void enqueue(FilaCircular *fila, Peca p) {
     if (filaEstaCheia(fila)) return; // Guarda de segurança
     fila->itens[fila->rear] = p;
-    fila->rear = (fila->rear + 1) % MAX_FILA;
+    fila->rear = (fila->rear + 1) & (fila->capacidade - 1);
     fila->count++;
 }
 Peca dequeue(FilaCircular *fila) {
     Peca pecaJogada = fila->itens[fila->front];
-    fila->front = (fila->front + 1) % MAX_FILA;
+    fila->front = (fila->front + 1) & (fila->capacidade - 1);
     fila->count--;
     return pecaJogada;
 }
 
+/**
+ * @brief Copia as 'n' peças da frente da fila para 'destino', em ordem.
+ * No anel mágico é um memcpy só; no heap, dois quando dá a volta.
+ */
+void copiarFrenteFila(FilaCircular *fila, Peca *destino, int n) {
+    int ateOFim = fila->capacidade - fila->front;
+    if (fila->espelhada || n <= ateOFim) {
+        memcpy(destino, &fila->itens[fila->front], n * sizeof(Peca));
+    } else {
+        memcpy(destino, &fila->itens[fila->front], ateOFim * sizeof(Peca));
+        memcpy(destino + ateOFim, fila->itens, (n - ateOFim) * sizeof(Peca));
+    }
+}
+
 // --- Funções da Pilha ---
 void inicializarPilha(PilhaLinear *pilha) {
     pilha->topo = -1;
@@ -92,57 +303,262 @@ Peca pop(PilhaLinear *pilha) {
 
 
 // -----------------------------------------------------------------
-// 3. FUNÇÕES DE GERENCIAMENTO DO JOGO
+// 3. FUNÇÕES DE ESPECULAÇÃO (BEGIN / COMMIT / ROLLBACK)
+// -----------------------------------------------------------------
+
+void inicializarEspeculacao(Especulacao *esp) {
+    esp->estado = NULL;
+    esp->nivel = 0;
+    esp->tamanhoLog = 0;
+}
+
+/**
+ * @brief Registra o valor antigo de um slot do estado antes de sobrescrevê-lo.
+ * Sem especulação aberta sobre o estado não faz nada.
+ * O espaço no log é garantido antes da ação por logTemEspaco().
+ */
+void anotarEscrita(EstadoJogo *estado, Peca *slot) {
+    Especulacao *esp = estado->especulacao;
+    if (esp == NULL) return;
+    esp->log[esp->tamanhoLog].slot = slot;
+    esp->log[esp->tamanhoLog].antigo = *slot;
+    esp->tamanhoLog++;
+}
+
+/**
+ * @brief Verifica se o log comporta mais uma ação sobre o estado.
+ * As ações chamam antes de escrever: se não couber, a ação é recusada
+ * em vez de deixar o estado sem volta.
+ */
+int logTemEspaco(EstadoJogo *estado) {
+    Especulacao *esp = estado->especulacao;
+    if (esp == NULL) return 1;
+    if (esp->tamanhoLog + MAX_ESCRITAS_POR_ACAO > MAX_LOG_ESCRITAS) {
+        printf("\n>> ERRO: Log de especulacao cheio; confirme ou reverta antes.\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Abre um nível de especulação sobre o estado (begin).
+ * Pode ser aninhado (ex: olhar várias jogadas à frente).
+ * Retorna 0 se já houver MAX_ESPECULACAO níveis abertos ou se
+ * 'esp' ou o estado já estiverem ligados a outra especulação.
+ */
+int iniciarEspeculacao(Especulacao *esp, EstadoJogo *estado) {
+    if (esp->nivel == MAX_ESPECULACAO) return 0;
+    if (esp->nivel == 0) {
+        if (estado->especulacao != NULL) return 0;
+        esp->estado = estado;
+        estado->especulacao = esp;
+    } else if (esp->estado != estado) {
+        return 0;
+    }
+
+    Checkpoint *cp = &esp->niveis[esp->nivel++];
+    cp->frontFila = estado->fila.front;
+    cp->rearFila = estado->fila.rear;
+    cp->countFila = estado->fila.count;
+    cp->topoPilha = estado->pilha.topo;
+    cp->proximoId = estado->proximoId;
+    cp->stats = estado->stats;
+    cp->inicioLog = esp->tamanhoLog;
+    return 1;
+}
+
+/**
+ * @brief Solta o estado quando o último nível é fechado.
+ */
+void encerrarEspeculacao(Especulacao *esp) {
+    esp->tamanhoLog = 0;
+    esp->estado->especulacao = NULL;
+    esp->estado = NULL;
+}
+
+/**
+ * @brief Confirma o nível mais interno (commit).
+ * As escritas passam a pertencer ao nível de fora, que ainda pode revertê-las.
+ */
+void confirmarEspeculacao(Especulacao *esp) {
+    if (esp->nivel == 0) return;
+    esp->nivel--;
+    if (esp->nivel == 0) encerrarEspeculacao(esp);
+}
+
+/**
+ * @brief Desfaz tudo o que foi escrito desde o último iniciarEspeculacao (rollback).
+ * Retorna 0 se não havia nível aberto.
+ */
+int reverterEspeculacao(Especulacao *esp) {
+    if (esp->nivel == 0) return 0;
+
+    Checkpoint *cp = &esp->niveis[--esp->nivel];
+
+    // Restaura os slots na ordem inversa das escritas
+    for (int i = esp->tamanhoLog - 1; i >= cp->inicioLog; i--) {
+        *esp->log[i].slot = esp->log[i].antigo;
+    }
+    esp->tamanhoLog = cp->inicioLog;
+
+    EstadoJogo *estado = esp->estado;
+    estado->fila.front = cp->frontFila;
+    estado->fila.rear = cp->rearFila;
+    estado->fila.count = cp->countFila;
+    estado->pilha.topo = cp->topoPilha;
+    estado->proximoId = cp->proximoId;
+    estado->stats = cp->stats;
+
+    if (esp->nivel == 0) encerrarEspeculacao(esp);
+    return 1;
+}
+
+
+// -----------------------------------------------------------------
+// 4. FUNÇÕES DE GERENCIAMENTO DO JOGO
 // -----------------------------------------------------------------
 
+/**
+ * @brief Calcula o tipo da peça de número 'id' direto da semente.
+ * Não depende de quantas peças já foram geradas (ao contrário de rand()),
+ * então qualquer peça passada ou futura pode ser consultada em O(1).
+ */
+char tipoDaPeca(unsigned int semente, int id) {
+    char tipos[] = TIPOS_PECA;
+    unsigned int x = (unsigned int)id * 0x9E3779B9u + semente;
+
+    // Embaralha os bits (finalizador do MurmurHash3)
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+
+    return tipos[x % NUM_TIPOS];
+}
+
 /**
  * @brief Gera uma nova peça.
  * Agora recebe o ponteiro do contador de ID do estado do jogo.
+ * O tipo vem de tipoDaPeca(), então desfazer e jogar de novo
+ * produz a mesma peça.
  */
 Peca gerarPeca(int *idCounter) {
     Peca p;
-    char tipos[] = "IOTLSJZ";
-    p.nome = tipos[rand() % 7];
     p.id = (*idCounter)++; // Usa e incrementa o ID do estado
+    p.nome = tipoDaPeca(g_semente, p.id);
     return p;
 }
 
 /**
- * @brief Salva um estado (origem) em outro (destino).
- * Isso é o coração da função "Desfazer".
+ * @brief Compara dois estados peça a peça (na ordem lógica da fila).
+ */
+int estadosIguais(EstadoJogo *a, EstadoJogo *b) {
+    if (a->proximoId != b->proximoId) return 0;
+    if (a->fila.count != b->fila.count || a->pilha.topo != b->pilha.topo) return 0;
+
+    int indiceA = a->fila.front;
+    int indiceB = b->fila.front;
+    for (int i = 0; i < a->fila.count; i++) {
+        if (a->fila.itens[indiceA].nome != b->fila.itens[indiceB].nome ||
+            a->fila.itens[indiceA].id != b->fila.itens[indiceB].id) return 0;
+        indiceA = (indiceA + 1) & (a->fila.capacidade - 1);
+        indiceB = (indiceB + 1) & (b->fila.capacidade - 1);
+    }
+    for (int i = 0; i <= a->pilha.topo; i++) {
+        if (a->pilha.itens[i].nome != b->pilha.itens[i].nome ||
+            a->pilha.itens[i].id != b->pilha.itens[i].id) return 0;
+    }
+    return memcmp(&a->stats, &b->stats, sizeof(Estatisticas)) == 0;
+}
+
+/**
+ * @brief Copia o conteúdo de um estado para outro.
+ * 'destino' precisa ter a fila já alocada com a mesma capacidade;
+ * a especulação de 'destino' não é alterada.
  */
-void salvarEstado(EstadoJogo *destino, EstadoJogo *origem) {
-    // A atribuição de structs em C faz uma cópia byte-a-byte
-    // Isso funciona perfeitamente para nossas estruturas.
-    *destino = *origem;
+void copiarEstado(EstadoJogo *destino, EstadoJogo *origem) {
+    memcpy(destino->fila.itens, origem->fila.itens, origem->fila.capacidade * sizeof(Peca));
+    destino->fila.front = origem->fila.front;
+    destino->fila.rear = origem->fila.rear;
+    destino->fila.count = origem->fila.count;
+    destino->fila.tamanho = origem->fila.tamanho;
+    destino->pilha = origem->pilha;
+    destino->proximoId = origem->proximoId;
+    destino->stats = origem->stats;
 }
 
 /**
  * @brief Função de conveniência para repor a fila.
- * Mantém a fila com 5 peças, como no Nível Aventureiro.
+ * Mantém a fila cheia, como no Nível Aventureiro.
  */
 void reporPecaFila(EstadoJogo *estado) {
     if (!filaEstaCheia(&estado->fila)) {
         Peca novaPeca = gerarPeca(&estado->proximoId);
+        anotarEscrita(estado, &estado->fila.itens[estado->fila.rear]);
         enqueue(&estado->fila, novaPeca);
         printf(">> Nova Peca [%c %d] entrou na fila.\n", novaPeca.nome, novaPeca.id);
     }
 }
 
+/**
+ * @brief Registra uma peça jogada nas estatísticas.
+ */
+void registrarPecaJogada(Estatisticas *stats, Peca p) {
+    char *tipo = strchr(TIPOS_PECA, p.nome);
+    stats->pecasJogadas++;
+    if (tipo != NULL) stats->frequencia[tipo - TIPOS_PECA]++;
+}
+
 // -----------------------------------------------------------------
-// 4. FUNÇÕES DE EXIBIÇÃO
+// 5. FUNÇÕES DE EXIBIÇÃO
 // -----------------------------------------------------------------
 
+/**
+ * @brief Copia para 'visao' a parte do estado que aparece na tela.
+ */
+void capturarVisao(EstadoJogo *estado, VisaoEstado *visao) {
+    int visiveis = estado->fila.count < JANELA_FILA ? estado->fila.count : JANELA_FILA;
+
+    visao->countFila = estado->fila.count;
+    copiarFrenteFila(&estado->fila, visao->frenteFila, visiveis);
+    visao->pilha = estado->pilha;
+}
+
+int filasVisiveisIguais(VisaoEstado *a, VisaoEstado *b) {
+    if (a->countFila != b->countFila) return 0;
+    int visiveis = a->countFila < JANELA_FILA ? a->countFila : JANELA_FILA;
+    for (int i = 0; i < visiveis; i++) {
+        if (a->frenteFila[i].nome != b->frenteFila[i].nome ||
+            a->frenteFila[i].id != b->frenteFila[i].id) return 0;
+    }
+    return 1;
+}
+
+int pilhasIguais(PilhaLinear *a, PilhaLinear *b) {
+    if (a->topo != b->topo) return 0;
+    for (int i = 0; i <= a->topo; i++) {
+        if (a->itens[i].nome != b->itens[i].nome ||
+            a->itens[i].id != b->itens[i].id) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Exibe a fila (só as JANELA_FILA primeiras peças).
+ */
 void visualizarFila(FilaCircular *fila) {
     printf("Fila de Pecas: ");
     if (filaEstaVazia(fila)) {
         printf("[VAZIA]");
     } else {
+        int visiveis = fila->count < JANELA_FILA ? fila->count : JANELA_FILA;
         int indice = fila->front;
-        for (int i = 0; i < fila->count; i++) {
+        for (int i = 0; i < visiveis; i++) {
             printf("[%c %d] ", fila->itens[indice].nome, fila->itens[indice].id);
-            indice = (indice + 1) % MAX_FILA;
+            indice = (indice + 1) & (fila->capacidade - 1);
         }
+        if (fila->count > visiveis) printf("... (+%d)", fila->count - visiveis);
     }
     printf("\n");
 }
@@ -167,27 +583,75 @@ void exibirMenu() {
     printf("4 - Trocar peca da frente da fila com o topo da pilha\n");
     printf("5 - Desfazer ultima jogada\n");
     printf("6 - Inverter fila com pilha (troca 3x3)\n");
+    printf("7 - Mostrar estado completo e menu\n");
     printf("0 - Sair\n");
-    printf("Opcao: ");
+}
+
+void exibirEstatisticas(Estatisticas *stats) {
+    printf("\n=== Estatisticas da Partida ===\n");
+    printf("Pecas jogadas: %d\n", stats->pecasJogadas);
+    printf("Reservas feitas: %d | usadas: %d\n", stats->reservasFeitas, stats->reservasUsadas);
+    printf("Trocas topo/frente: %d | trocas 3x3: %d\n", stats->trocasTopoFrente, stats->trocas3x3);
+    printf("Pecas por tipo: ");
+    for (int i = 0; i < NUM_TIPOS; i++) {
+        printf("[%c %d] ", TIPOS_PECA[i], stats->frequencia[i]);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Lê a opção do menu (substitui o scanf("%d")).
+ * Tokenizador simples sobre getchar(): pula espaços, lê um inteiro e
+ * devolve o caractere seguinte para a entrada. Se o token não começar
+ * com um número, descarta o resto da linha e devolve -1 (opção
+ * inválida), como antes. No fim da entrada devolve 0 (Sair).
+ */
+int lerOpcao() {
+    int c;
+    do {
+        c = getchar();
+    } while (isspace(c));
+    if (c == EOF) return 0;
+
+    int sinal = 1;
+    if (c == '-' || c == '+') {
+        if (c == '-') sinal = -1;
+        c = getchar();
+    }
+    if (!isdigit(c)) {
+        while (c != '\n' && c != EOF) c = getchar(); // Limpa buffer
+        return -1;
+    }
+
+    int valor = 0;
+    while (isdigit(c)) {
+        if (valor < 100000) valor = valor * 10 + (c - '0'); // Evita overflow
+        c = getchar();
+    }
+    ungetc(c, stdin); // Deixa o resto para a próxima leitura
+    return sinal * valor;
 }
 
 // -----------------------------------------------------------------
-// 5. FUNÇÕES DAS AÇÕES PRINCIPAIS
+// 6. FUNÇÕES DAS AÇÕES PRINCIPAIS
 // -----------------------------------------------------------------
 
 // Ação 1: Jogar Peça (Dequeue + Reposição)
 void acaoJogar(EstadoJogo *estado) {
+    if (!logTemEspaco(estado)) return;
     if (filaEstaVazia(&estado->fila)) {
         printf("\n>> ERRO: Fila vazia!\n");
         return;
     }
     Peca jogada = dequeue(&estado->fila);
     printf("\n>> Peca Jogada: [%c %d]\n", jogada.nome, jogada.id);
+    registrarPecaJogada(&estado->stats, jogada);
     reporPecaFila(estado);
 }
 
 // Ação 2: Reservar Peça (Dequeue -> Push + Reposição)
 void acaoReservar(EstadoJogo *estado) {
+    if (!logTemEspaco(estado)) return;
     if (pilhaEstaCheia(&estado->pilha)) {
         printf("\n>> ERRO: Pilha de reserva esta cheia!\n");
         return;
@@ -197,8 +661,10 @@ void acaoReservar(EstadoJogo *estado) {
         return;
     }
     Peca reservada = dequeue(&estado->fila);
+    anotarEscrita(estado, &estado->pilha.itens[estado->pilha.topo + 1]);
     push(&estado->pilha, reservada);
     printf("\n>> Peca Reservada: [%c %d]\n", reservada.nome, reservada.id);
+    estado->stats.reservasFeitas++;
     reporPecaFila(estado);
 }
 
@@ -210,10 +676,13 @@ void acaoUsarReserva(EstadoJogo *estado) {
     }
     Peca usada = pop(&estado->pilha);
     printf("\n>> Peca Usada da Reserva: [%c %d]\n", usada.nome, usada.id);
+    estado->stats.reservasUsadas++;
+    registrarPecaJogada(&estado->stats, usada);
 }
 
 // Ação 4: Troca Topo-Frente (Swap)
 void acaoTrocarTopoFrente(EstadoJogo *estado) {
+    if (!logTemEspaco(estado)) return;
     if (filaEstaVazia(&estado->fila)) {
         printf("\n>> ERRO: Fila vazia!\n");
         return;
@@ -228,128 +697,496 @@ void acaoTrocarTopoFrente(EstadoJogo *estado) {
     int indiceFrenteFila = estado->fila.front;
     int indiceTopoPilha = estado->pilha.topo;
 
+    anotarEscrita(estado, &estado->fila.itens[indiceFrenteFila]);
+    anotarEscrita(estado, &estado->pilha.itens[indiceTopoPilha]);
+
     Peca temp = estado->fila.itens[indiceFrenteFila];
     estado->fila.itens[indiceFrenteFila] = estado->pilha.itens[indiceTopoPilha];
     estado->pilha.itens[indiceTopoPilha] = temp;
     
+    estado->stats.trocasTopoFrente++;
     printf("\n>> Troca Topo/Frente realizada.\n");
 }
 
 // Ação 6: Trocar 3x3 (Complexo)
 void acaoInverter3x3(EstadoJogo *estado) {
+    if (!logTemEspaco(estado)) return;
     // Esta operação só funciona se ambas estiverem cheias (3 na pilha, 5 na fila)
     if (estado->fila.count < 3 || estado->pilha.topo < 2) {
         printf("\n>> ERRO: Acao requer 3 pecas na pilha e pelo menos 3 na fila.\n");
         return;
     }
 
-    // 1. Armazena peças temporárias
+    // Troca no lugar: a i-ésima peça da fila (a partir da frente) troca
+    // com a i-ésima peça da pilha (a partir do topo).
+    // Ex: Fila [A, B, C] D E, Pilha (Topo -> Base) [Z, Y, X]
+    //  -> Fila [Z, Y, X] D E, Pilha (Topo -> Base) [A, B, C]
+    // O resto da fila (D E) não sai do lugar, então só 6 slots são escritos.
+    for (int i = 0; i < 3; i++) {
+        int indiceFila = (estado->fila.front + i) & (estado->fila.capacidade - 1);
+        int indicePilha = estado->pilha.topo - i;
+
+        anotarEscrita(estado, &estado->fila.itens[indiceFila]);
+        anotarEscrita(estado, &estado->pilha.itens[indicePilha]);
+
+        Peca temp = estado->fila.itens[indiceFila];
+        estado->fila.itens[indiceFila] = estado->pilha.itens[indicePilha];
+        estado->pilha.itens[indicePilha] = temp;
+    }
+
+    estado->stats.trocas3x3++;
+    printf("\n>> Troca 3x3 realizada.\n");
+}
+
+
+// -----------------------------------------------------------------
+// 7. PAINEL COMPARTILHADO (ESPECTADORES)
+// -----------------------------------------------------------------
+
+/**
+ * @brief Cria a memória compartilhada onde o estado é publicado.
+ * O_EXCL: só um jogo pode publicar por vez (dois escritores
+ * corromperiam o seqlock e um apagaria o painel do outro).
+ * Retorna NULL (e o jogo segue sem publicar) se algo falhar.
+ */
+/**
+ * @brief Diz se o painel existente foi deixado por um jogo que morreu
+ * (crash, kill -9) sem chamar fecharPainel().
+ * Um painel ainda em preparo (sem pid) ou de outra versão não é abandonado.
+ */
+int painelAbandonado() {
+    int fd = shm_open(NOME_PAINEL, O_RDONLY, 0);
+    if (fd == -1) return errno == ENOENT; // Sumiu nesse meio tempo
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size != (off_t)sizeof(PainelCompartilhado)) {
+        close(fd);
+        return 0;
+    }
+    PainelCompartilhado *antigo = mmap(NULL, sizeof(PainelCompartilhado),
+                                       PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (antigo == MAP_FAILED) return 0;
+
+    pid_t pid = antigo->pidJogo;
+    munmap(antigo, sizeof(PainelCompartilhado));
+    return pid > 0 && kill(pid, 0) == -1 && errno == ESRCH;
+}
+
+PainelCompartilhado *abrirPainel() {
+    int fd = shm_open(NOME_PAINEL, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1 && errno == EEXIST && painelAbandonado()) {
+        printf("Removendo o painel de uma partida que terminou sem fechar.\n");
+        shm_unlink(NOME_PAINEL);
+        fd = shm_open(NOME_PAINEL, O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd == -1) {
+        if (errno == EEXIST) {
+            printf(">> ERRO: Outra partida ja esta publicando em %s.\n", NOME_PAINEL);
+        } else {
+            printf(">> ERRO: Nao foi possivel criar o painel compartilhado.\n");
+        }
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(PainelCompartilhado)) == -1) {
+        printf(">> ERRO: Nao foi possivel criar o painel compartilhado.\n");
+        close(fd);
+        shm_unlink(NOME_PAINEL);
+        return NULL;
+    }
+
+    PainelCompartilhado *painel = mmap(NULL, sizeof(PainelCompartilhado),
+                                       PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // O mapeamento continua válido sem o descritor
+    if (painel == MAP_FAILED) {
+        printf(">> ERRO: Nao foi possivel criar o painel compartilhado.\n");
+        shm_unlink(NOME_PAINEL);
+        return NULL;
+    }
+
+    painel->tamanhoPainel = sizeof(PainelCompartilhado);
+    painel->pidJogo = getpid();
+    atomic_store(&painel->sequencia, 0);
+    atomic_store(&painel->ativo, 1); // Por último: espectadores esperam por ele
+    g_painel = painel;
+    printf("Publicando o estado em %s (use ./tetrisespectador).\n", NOME_PAINEL);
+    return painel;
+}
+
+/**
+ * @brief Publica a visão do estado (lado escritor do seqlock).
+ * Sem syscalls e sem esperar: leitores que pegarem a cópia pela
+ * metade percebem pela 'sequencia' e leem de novo.
+ */
+void publicarEstado(PainelCompartilhado *painel, EstadoJogo *estado) {
+    unsigned int seq = atomic_load_explicit(&painel->sequencia, memory_order_relaxed);
+
+    atomic_store_explicit(&painel->sequencia, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    capturarVisao(estado, &painel->visao);
+    painel->proximoId = estado->proximoId;
+    painel->stats = estado->stats;
+    atomic_store_explicit(&painel->sequencia, seq + 2, memory_order_release);
+}
+
+/**
+ * @brief Avisa os espectadores que o jogo acabou e remove o painel.
+ */
+void fecharPainel(PainelCompartilhado *painel) {
+    g_painel = NULL; // Um sinal agora não fecha de novo
+    atomic_store(&painel->ativo, 0);
+    munmap(painel, sizeof(PainelCompartilhado));
+    shm_unlink(NOME_PAINEL); // Quem já abriu continua lendo até fechar
+}
+
+/**
+ * @brief Fecha o painel e termina com o sinal recebido (Ctrl+C, SIGTERM).
+ */
+void encerrarPorSinal(int sinal) {
+    if (g_painel != NULL) fecharPainel(g_painel);
+    signal(sinal, SIG_DFL);
+    raise(sinal);
+}
+
+
+// -----------------------------------------------------------------
+// 8. VERIFICAÇÃO DO MOTOR (REFERÊNCIA x OTIMIZADO)
+// -----------------------------------------------------------------
+
+#define PASSOS_VERIFICACAO 64 // Ações por sequência aleatória
+
+/**
+ * @brief Troca 3x3 de referência: a versão original com pop/dequeue/push/enqueue.
+ * Usada só pela verificação, para comparar com acaoInverter3x3 (troca no lugar).
+ * 'tempRestoFila' guarda o resto da fila: alocado uma vez por sequência,
+ * com fila.tamanho peças.
+ */
+void acaoInverter3x3Referencia(EstadoJogo *estado, Peca *tempRestoFila) {
+    if (estado->fila.count < 3 || estado->pilha.topo < 2) return;
+
     Peca tempPilha[3];
     Peca tempFila[3];
+    int restoCount = estado->fila.count - 3;
     int i;
 
-    // 2. Salva o resto da fila (se houver)
-    int restoCount = estado->fila.count - 3;
-    Peca tempRestoFila[MAX_FILA - 3];
+    for (i = 0; i < 3; i++) tempPilha[i] = pop(&estado->pilha);
+    for (i = 0; i < 3; i++) tempFila[i] = dequeue(&estado->fila);
+    for (i = 0; i < restoCount; i++) tempRestoFila[i] = dequeue(&estado->fila);
 
-    // 3. Esvazia 3 da Pilha (Topo -> Base)
-    // Ex: [Z, Y, X] -> tempPilha = {Z, Y, X}
-    for (i = 0; i < 3; i++) {
-        tempPilha[i] = pop(&estado->pilha);
+    for (i = 2; i >= 0; i--) push(&estado->pilha, tempFila[i]);
+    for (i = 0; i < 3; i++) enqueue(&estado->fila, tempPilha[i]);
+    for (i = 0; i < restoCount; i++) enqueue(&estado->fila, tempRestoFila[i]);
+
+    estado->stats.trocas3x3++;
+}
+
+/**
+ * @brief Executa uma ação (1 a 6, sem o Desfazer) no estado.
+ * Com 'bufferReferencia' != NULL usa a troca 3x3 de referência.
+ */
+void executarAcao(EstadoJogo *estado, int acao, Peca *bufferReferencia) {
+    switch (acao) {
+        case 1: acaoJogar(estado); break;
+        case 2: acaoReservar(estado); break;
+        case 3: acaoUsarReserva(estado); break;
+        case 4: acaoTrocarTopoFrente(estado); break;
+        case 6:
+            if (bufferReferencia != NULL) acaoInverter3x3Referencia(estado, bufferReferencia);
+            else acaoInverter3x3(estado);
+            break;
     }
+}
+
+void inicializarEstado(EstadoJogo *estado, int tamanhoFila) {
+    inicializarFila(&estado->fila, tamanhoFila);
+    inicializarPilha(&estado->pilha);
+    estado->proximoId = 0;
+    memset(&estado->stats, 0, sizeof(Estatisticas));
+    estado->especulacao = NULL;
+}
 
-    // 4. Esvazia 3 da Fila (Frente -> Tras)
-    // Ex: [A, B, C] D E -> tempFila = {A, B, C}
-    for (i = 0; i < 3; i++) {
-        tempFila[i] = dequeue(&estado->fila);
+/**
+ * @brief Roda sequências aleatórias de ações em dois motores em paralelo:
+ * - modelo: o motor atual (troca 3x3 no lugar, Desfazer por especulação);
+ * - referência: a semântica original (troca 3x3 com pop/dequeue e
+ *   Desfazer por cópia completa do estado anterior).
+ * Para na primeira divergência de estado, proximoId ou resultado do Desfazer
+ * e a descreve. Retorna 0 se tudo bateu.
+ */
+int verificarSequencias(int sequencias, unsigned int semente) {
+    srand(semente);
+
+    // As ações imprimem mensagens; durante a verificação vão para /dev/null
+    fflush(stdout);
+    int saidaOriginal = dup(STDOUT_FILENO);
+    int nulo = open("/dev/null", O_WRONLY);
+    dup2(nulo, STDOUT_FILENO);
+    close(nulo);
+
+    int divergiu = 0, semMemoria = 0;
+    int seq, passo = 0, acao = 0;
+    int desfezModelo = 0, desfezReferencia = 0;
+    EstadoJogo modelo, referencia, anterior;
+    Especulacao especulacao;
+
+    for (seq = 0; seq < sequencias; seq++) {
+        // Tamanhos variados para exercitar a volta do buffer circular
+        int tamanhoFila = 3 + rand() % 14;
+        inicializarEstado(&modelo, tamanhoFila);
+        inicializarEstado(&referencia, tamanhoFila);
+        inicializarEstado(&anterior, tamanhoFila);
+        inicializarEspeculacao(&especulacao);
+        Peca *bufferReferencia = malloc(tamanhoFila * sizeof(Peca));
+        if (bufferReferencia == NULL) {
+            semMemoria = 1;
+            break;
+        }
+        for (int i = 0; i < tamanhoFila; i++) {
+            enqueue(&modelo.fila, gerarPeca(&modelo.proximoId));
+            enqueue(&referencia.fila, gerarPeca(&referencia.proximoId));
+        }
+        int temAnterior = 0;
+
+        for (passo = 0; passo < PASSOS_VERIFICACAO; passo++) {
+            acao = 1 + rand() % 6;
+            if (acao == 5) {
+                desfezModelo = reverterEspeculacao(&especulacao);
+                desfezReferencia = temAnterior;
+                if (temAnterior) copiarEstado(&referencia, &anterior);
+                temAnterior = 0;
+            } else {
+                // Mesmo protocolo do laço principal
+                confirmarEspeculacao(&especulacao);
+                iniciarEspeculacao(&especulacao, &modelo);
+                executarAcao(&modelo, acao, NULL);
+
+                copiarEstado(&anterior, &referencia);
+                temAnterior = 1;
+                executarAcao(&referencia, acao, bufferReferencia);
+                desfezModelo = desfezReferencia = 0;
+            }
+            if (desfezModelo != desfezReferencia || !estadosIguais(&modelo, &referencia)) {
+                divergiu = 1;
+                break;
+            }
+        }
+
+        confirmarEspeculacao(&especulacao);
+        free(bufferReferencia);
+        if (divergiu) break; // Mantém os estados para o relatório
+        liberarFila(&modelo.fila);
+        liberarFila(&referencia.fila);
+        liberarFila(&anterior.fila);
     }
-    
-    // 5. Salva o resto da fila
-    // Ex: D E -> tempRestoFila = {D, E}
-    for (i = 0; i < restoCount; i++) {
-        tempRestoFila[i] = dequeue(&estado->fila);
-    }
-    // Fila agora está vazia
-
-    // 6. Empilha as peças da Fila na Pilha (na ordem inversa)
-    // Ex: tempFila = {A, B, C} -> push(C), push(B), push(A)
-    // Nova Pilha (Topo -> Base): [A, B, C] (Invertido da imagem, mas consistente)
-    // Correção para BATER com a imagem: [T 2][L 1][I 0]
-    // tempFila[0]=I0, tempFila[1]=L1, tempFila[2]=T2
-    // push(tempFila[2]) -> T2
-    // push(tempFila[1]) -> L1
-    // push(tempFila[0]) -> I0
-    for (i = 2; i >= 0; i--) {
-        push(&estado->pilha, tempFila[i]);
-    }
-
-    // 7. Enfileira as peças da Pilha na Fila (na ordem)
-    // Ex: tempPilha = {Z, Y, X} -> enqueue(Z), enqueue(Y), enqueue(X)
-    // Correção para BATER com a imagem: [O 8][L 7][T 6]
-    // tempPilha[0]=O8, tempPilha[1]=L7, tempPilha[2]=T6
-    // enqueue(tempPilha[0]) -> O8
-    // enqueue(tempPilha[1]) -> L7
-    // enqueue(tempPilha[2]) -> T6
-    for (i = 0; i < 3; i++) {
-        enqueue(&estado->fila, tempPilha[i]);
-    }
-
-    // 8. Devolve o resto para a fila
-    // Ex: enqueue(D), enqueue(E)
-    for (i = 0; i < restoCount; i++) {
-        enqueue(&estado->fila, tempRestoFila[i]);
+
+    fflush(stdout);
+    dup2(saidaOriginal, STDOUT_FILENO);
+    close(saidaOriginal);
+
+    if (semMemoria) {
+        printf(">> ERRO: Memoria insuficiente na sequencia %d.\n", seq);
+        liberarFila(&modelo.fila);
+        liberarFila(&referencia.fila);
+        liberarFila(&anterior.fila);
+        return 1;
     }
+    if (!divergiu) return 0;
 
-    printf("\n>> Troca 3x3 realizada.\n");
+    printf("DIVERGENCIA na sequencia %d, passo %d, acao %d\n", seq, passo, acao);
+    printf("Repita com: --semente %u --verificar %d --processos 1\n", semente, seq + 1);
+    printf("Desfazer: modelo=%d referencia=%d\n", desfezModelo, desfezReferencia);
+    printf("proximoId: modelo=%d referencia=%d\n", modelo.proximoId, referencia.proximoId);
+    printf("-- Modelo --\n");
+    visualizarFila(&modelo.fila);
+    visualizarPilha(&modelo.pilha);
+    printf("-- Referencia --\n");
+    visualizarFila(&referencia.fila);
+    visualizarPilha(&referencia.pilha);
+    liberarFila(&modelo.fila);
+    liberarFila(&referencia.fila);
+    liberarFila(&anterior.fila);
+    fflush(stdout);
+    return 1;
+}
+
+/**
+ * @brief Divide as sequências entre 'processos' filhos (fork), cada um
+ * com a semente g_semente + k, e junta os códigos de saída.
+ * Retorna 0 se nenhum processo encontrou divergência.
+ */
+int verificarMotor(int sequencias, int processos) {
+    if (processos > sequencias) processos = sequencias;
+    printf("Verificando %d sequencias de %d acoes (semente %u, %d processo(s))...\n",
+           sequencias, PASSOS_VERIFICACAO, g_semente, processos);
+    fflush(stdout); // Os filhos herdam o buffer de saída
+
+    int falhas = 0;
+    int filhos = 0;
+    for (int k = 0; k < processos; k++) {
+        int parte = sequencias / processos + (k < sequencias % processos);
+        unsigned int semente = g_semente + (unsigned int)k;
+        pid_t pid = processos > 1 ? fork() : -1;
+        if (pid == 0) {
+            _exit(verificarSequencias(parte, semente));
+        }
+        if (pid > 0) {
+            filhos++;
+        } else if (verificarSequencias(parte, semente) != 0) {
+            falhas++; // Um processo só, ou fork falhou: roda aqui mesmo
+        }
+    }
+
+    for (; filhos > 0; filhos--) {
+        int status;
+        if (wait(&status) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            falhas++;
+        }
+    }
+
+    if (falhas > 0) return 1;
+    printf("OK: %d sequencias sem divergencia.\n", sequencias);
+    return 0;
 }
 
 
 // -----------------------------------------------------------------
-// 6. FUNÇÃO PRINCIPAL (MAIN)
+// 9. FUNÇÃO PRINCIPAL (MAIN)
 // -----------------------------------------------------------------
 
-int main() {
-    srand(time(NULL));
+int main(int argc, char *argv[]) {
+    g_semente = (unsigned int)time(NULL);
+    // Entrada vinda de pipe/arquivo: lê em blocos grandes
+    if (!isatty(fileno(stdin))) setvbuf(stdin, NULL, _IOFBF, 1 << 16);
 
     EstadoJogo estadoAtual;
-    EstadoJogo estadoAnterior;
+    Especulacao especulacao; // Guarda a última ação para o Desfazer
+    VisaoEstado visaoExibida; // O que está na tela agora
+    VisaoEstado visaoAtual;
+    int redesenharTudo = 1;
     int opcao = -1;
 
     // --- Inicialização do Estado Atual ---
-    inicializarFila(&estadoAtual.fila);
+    // Argumentos: ./tetris [tamanho] [--semente N] [--publicar] [--verificar N] [--processos K]
+    // tamanho: tamanho da fila, padrão TAMANHO_FILA_PADRAO
+    // --semente: repete a sequência de peças de uma partida anterior
+    // --publicar: publica o estado para espectadores (tetrisespectador)
+    // --verificar: compara N sequências aleatórias com o motor de referência
+    // --processos: processos da verificação, padrão um por núcleo
+    int tamanhoFila = TAMANHO_FILA_PADRAO;
+    PainelCompartilhado *painel = NULL;
+    int publicar = 0;
+    int sequenciasVerificacao = 0;
+    int processosVerificacao = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (processosVerificacao < 1) processosVerificacao = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--verificar") == 0) {
+            if (i + 1 == argc || atoi(argv[i + 1]) < 1) {
+                printf("Use --verificar <numero de sequencias>.\n");
+                return 1;
+            }
+            sequenciasVerificacao = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--processos") == 0) {
+            if (i + 1 == argc || atoi(argv[i + 1]) < 1) {
+                printf("Use --processos <numero de processos>.\n");
+                return 1;
+            }
+            processosVerificacao = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--publicar") == 0) {
+            publicar = 1; // O painel só é criado depois de validar tudo
+            continue;
+        }
+        if (strcmp(argv[i], "--semente") == 0) {
+            char *fim;
+            if (i + 1 == argc || !isdigit((unsigned char)argv[i + 1][0])) {
+                printf("Use --semente <numero>.\n");
+                return 1;
+            }
+            errno = 0;
+            unsigned long semente = strtoul(argv[++i], &fim, 10);
+            if (*fim != '\0' || errno == ERANGE || semente > UINT_MAX) {
+                printf("Semente invalida: %s (use 0 a %u)\n", argv[i], UINT_MAX);
+                return 1;
+            }
+            g_semente = (unsigned int)semente;
+            continue;
+        }
+        char *fim;
+        long tamanho = strtol(argv[i], &fim, 10);
+        tamanhoFila = (int)tamanho;
+        if (*fim != '\0' || tamanho < 1 || tamanho > LIMITE_FILA) {
+            printf("Tamanho da fila invalido (use 1 a %d).\n", LIMITE_FILA);
+            return 1;
+        }
+    }
+
+    if (sequenciasVerificacao > 0) {
+        return verificarMotor(sequenciasVerificacao, processosVerificacao);
+    }
+
+    if (!inicializarFila(&estadoAtual.fila, tamanhoFila)) {
+        printf("Memoria insuficiente para uma fila de %d pecas.\n", tamanhoFila);
+        return 1;
+    }
     inicializarPilha(&estadoAtual.pilha);
     estadoAtual.proximoId = 0;
+    memset(&estadoAtual.stats, 0, sizeof(Estatisticas));
+    estadoAtual.especulacao = NULL;
+    inicializarEspeculacao(&especulacao);
+
+    // A semente identifica a sequência de peças: com ela, tipoDaPeca()
+    // reconstrói qualquer peça da partida fora deste processo
+    printf("Semente da partida: %u (repita com --semente %u)\n", g_semente, g_semente);
 
-    // Preenche a fila inicial com 5 peças
-    printf("Inicializando fila com %d pecas...\n", MAX_FILA);
-    for (int i = 0; i < MAX_FILA; i++) {
+    // Preenche a fila inicial até a capacidade escolhida
+    printf("Inicializando fila com %d pecas...\n", tamanhoFila);
+    for (int i = 0; i < tamanhoFila; i++) {
         // Gera peças usando o contador de ID do estado
         enqueue(&estadoAtual.fila, gerarPeca(&estadoAtual.proximoId));
     }
     
-    // Salva o estado inicial caso o usuário queira desfazer a primeira jogada
-    salvarEstado(&estadoAnterior, &estadoAtual);
+    // Publica para espectadores só agora, com a partida pronta para começar
+    if (publicar) {
+        painel = abrirPainel();
+        signal(SIGINT, encerrarPorSinal); // Ctrl+C ou kill também fecham o painel
+        signal(SIGTERM, encerrarPorSinal);
+    }
 
     // --- Loop Principal ---
     do {
         // 1. Mostra o estado atual
-        printf("\n=== Estado Atual ===\n");
-        visualizarFila(&estadoAtual.fila);
-        visualizarPilha(&estadoAtual.pilha);
-        
-        // 2. Mostra o menu
-        exibirMenu();
+        capturarVisao(&estadoAtual, &visaoAtual);
+        int filaMudou = redesenharTudo || !filasVisiveisIguais(&visaoExibida, &visaoAtual);
+        int pilhaMudou = redesenharTudo || !pilhasIguais(&visaoExibida.pilha, &visaoAtual.pilha);
 
-        // 3. Lê a opção
-        if (scanf("%d", &opcao) != 1) {
-            while(getchar() != '\n'); // Limpa buffer
-            opcao = -1;
+        if (redesenharTudo) {
+            // Tela completa só no início ou quando pedida (opção 7)
+            printf("\n=== Estado Atual ===\n");
+            visualizarFila(&estadoAtual.fila);
+            visualizarPilha(&estadoAtual.pilha);
+            exibirMenu();
+            redesenharTudo = 0;
+        } else {
+            // 2. O menu não muda: reimprime só a linha que mudou
+            if (filaMudou) visualizarFila(&estadoAtual.fila);
+            if (pilhaMudou) visualizarPilha(&estadoAtual.pilha);
         }
+        if (painel != NULL && (filaMudou || pilhaMudou)) publicarEstado(painel, &estadoAtual);
+        visaoExibida = visaoAtual;
+        printf("Opcao: ");
 
-        // 4. Salva o estado ANTES de executar a ação
-        // Não salva se a ação for Sair (0) ou Desfazer (5)
-        if (opcao != 0 && opcao != 5) {
-            salvarEstado(&estadoAnterior, &estadoAtual);
+        // 3. Lê a opção
+        opcao = lerOpcao();
+
+        // 4. Confirma a jogada anterior e abre uma especulação para esta
+        // O Desfazer reverte só os slots que a ação escrever (sem copiar o estado)
+        // Não abre se a ação for Sair (0), Desfazer (5) ou Mostrar (7)
+        if (opcao != 0 && opcao != 5 && opcao != 7) {
+            confirmarEspeculacao(&especulacao);
+            iniciarEspeculacao(&especulacao, &estadoAtual);
         }
 
         // 5. Executa a ação
@@ -367,13 +1204,20 @@ int main() {
                 acaoTrocarTopoFrente(&estadoAtual);
                 break;
             case 5: // Desfazer
-                salvarEstado(&estadoAtual, &estadoAnterior);
-                printf("\n>> Ultima acao desfeita.\n");
+                if (reverterEspeculacao(&especulacao)) {
+                    printf("\n>> Ultima acao desfeita.\n");
+                } else {
+                    printf("\n>> ERRO: Nada para desfazer.\n");
+                }
                 break;
             case 6:
                 acaoInverter3x3(&estadoAtual);
                 break;
+            case 7:
+                redesenharTudo = 1;
+                break;
             case 0:
+                exibirEstatisticas(&estadoAtual.stats);
                 printf("\nSaindo do programa...\n");
                 break;
             default:
@@ -383,5 +1227,7 @@ int main() {
 
     } while (opcao != 0);
 
+    if (painel != NULL) fecharPainel(painel);
+    liberarFila(&estadoAtual.fila);
     return 0;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <ctype.h>
+#include <unistd.h>
 
 // -----------------------------------------------------------------
 // 1. DEFINIÇÕES E ESTRUTURAS
@@ -194,6 +196,39 @@ void exibirMenu() {
     printf("Opcao: ");
 }
 
+/**
+ * @brief Lê a opção do menu (substitui o scanf("%d")).
+ * Tokenizador simples sobre getchar(): pula espaços, lê um inteiro e
+ * devolve o caractere seguinte para a entrada. Se o token não começar
+ * com um número, descarta o resto da linha e devolve -1 (opção
+ * inválida), como antes. No fim da entrada devolve 0 (Sair).
+ */
+int lerOpcao() {
+    int c;
+    do {
+        c = getchar();
+    } while (isspace(c));
+    if (c == EOF) return 0;
+
+    int sinal = 1;
+    if (c == '-' || c == '+') {
+        if (c == '-') sinal = -1;
+        c = getchar();
+    }
+    if (!isdigit(c)) {
+        while (c != '\n' && c != EOF) c = getchar(); // Limpa buffer
+        return -1;
+    }
+
+    int valor = 0;
+    while (isdigit(c)) {
+        if (valor < 100000) valor = valor * 10 + (c - '0'); // Evita overflow
+        c = getchar();
+    }
+    ungetc(c, stdin); // Deixa o resto para a próxima leitura
+    return sinal * valor;
+}
+
 /**
  * @brief Função de conveniência para repor a fila.
  * Sempre que uma peça sai (dequeue), esta função é chamada
@@ -211,6 +246,8 @@ void reporPecaFila(FilaCircular *fila) {
 
 int main() {
     srand(time(NULL));
+    // Entrada vinda de pipe/arquivo: lê em blocos grandes
+    if (!isatty(fileno(stdin))) setvbuf(stdin, NULL, _IOFBF, 1 << 16);
 
     FilaCircular filaDePecas;
     PilhaLinear pilhaDeReserva;
@@ -237,10 +274,7 @@ int main() {
         exibirMenu();
 
         // 3. Lê a opção
-        if (scanf("%d", &opcao) != 1) {
-            while(getchar() != '\n'); // Limpa buffer
-            opcao = -1;
-        }
+        opcao = lerOpcao();
 
         // 4. Executa a ação
         switch (opcao) {
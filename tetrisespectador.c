@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+// -----------------------------------------------------------------
+// Espectador do Tetris Stack (Nível Mestre)
+// Acompanha uma partida iniciada com: ./tetris --publicar
+// Lê o estado da memória compartilhada sem nunca bloquear o jogo.
+// -----------------------------------------------------------------
+
+// -----------------------------------------------------------------
+// 1. DEFINIÇÕES E ESTRUTURAS
+// (Devem ser idênticas às do tetris.c, inclusive o JANELA_FILA)
+// -----------------------------------------------------------------
+
+#define MAX_PILHA 3
+#define JANELA_FILA 10
+
+#define TIPOS_PECA "IOTLSJZ"
+#define NUM_TIPOS 7
+
+#define NOME_PAINEL "/tetris_estado"
+#define INTERVALO_MS 200 // Intervalo entre leituras do painel
+#define ESPERA_PRONTO 25  // Leituras (de INTERVALO_MS) esperando o jogo preparar o painel
+#define MAX_TENTATIVAS 1000 // Releituras de 1 ms durante uma escrita (~1 s)
+
+typedef struct {
+    char nome;
+    int id;
+} Peca;
+
+typedef struct {
+    Peca itens[MAX_PILHA];
+    int topo; // -1 = vazia
+} PilhaLinear;
+
+typedef struct {
+    int pecasJogadas;
+    int reservasFeitas;
+    int reservasUsadas;
+    int trocasTopoFrente;
+    int trocas3x3;
+    int frequencia[NUM_TIPOS];
+} Estatisticas;
+
+/**
+ * @brief Visão publicada: a frente da fila e a pilha.
+ */
+typedef struct {
+    int countFila;
+    Peca frenteFila[JANELA_FILA];
+    PilhaLinear pilha;
+} VisaoEstado;
+
+/**
+ * @brief Região compartilhada escrita pelo jogo (seqlock).
+ * 'sequencia' ímpar = escrita em andamento.
+ */
+typedef struct {
+    atomic_uint sequencia;
+    atomic_int ativo;    // 0 quando o jogo termina
+    pid_t pidJogo;       // Processo que publica
+    int tamanhoPainel;   // sizeof(PainelCompartilhado) no jogo
+    VisaoEstado visao;
+    int proximoId;
+    Estatisticas stats;
+} PainelCompartilhado;
+
+/**
+ * @brief Cópia local do que o jogo publicou.
+ */
+typedef struct {
+    VisaoEstado visao;
+    int proximoId;
+    Estatisticas stats;
+} EstadoPublicado;
+
+
+// -----------------------------------------------------------------
+// 2. FUNÇÕES DO PAINEL
+// -----------------------------------------------------------------
+
+void dormirMs(long ms) {
+    struct timespec intervalo = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&intervalo, NULL);
+}
+
+/**
+ * @brief Diz se o processo que publica ainda existe.
+ * Um jogo morto (crash, kill -9) deixa 'ativo' em 1 para sempre.
+ */
+int jogoVivo(PainelCompartilhado *painel) {
+    return !(kill(painel->pidJogo, 0) == -1 && errno == ESRCH);
+}
+
+/**
+ * @brief Abre (somente leitura) o painel criado pelo jogo.
+ */
+PainelCompartilhado *abrirPainel() {
+    int fd = shm_open(NOME_PAINEL, O_RDONLY, 0);
+    if (fd == -1) {
+        printf(">> ERRO: Nenhuma partida publicada. Inicie com ./tetris --publicar\n");
+        return NULL;
+    }
+
+    PainelCompartilhado *painel = mmap(NULL, sizeof(PainelCompartilhado),
+                                       PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (painel == MAP_FAILED) {
+        printf(">> ERRO: Nao foi possivel mapear o painel.\n");
+        return NULL;
+    }
+
+    // O jogo cria a região e só depois a preenche ('ativo' vem por último).
+    // Enquanto 'ativo' for 0, o painel ainda não está pronto.
+    int espera = 0;
+    while (!atomic_load(&painel->ativo) && espera < ESPERA_PRONTO) {
+        dormirMs(INTERVALO_MS);
+        espera++;
+    }
+    if (!atomic_load(&painel->ativo)) {
+        printf(">> ERRO: O painel nao ficou pronto (a partida ja terminou?).\n");
+        munmap(painel, sizeof(PainelCompartilhado));
+        return NULL;
+    }
+
+    if (painel->tamanhoPainel != (int)sizeof(PainelCompartilhado)) {
+        printf(">> ERRO: O jogo foi compilado com estruturas diferentes (ex: outro JANELA_FILA).\n");
+        munmap(painel, sizeof(PainelCompartilhado));
+        return NULL;
+    }
+    return painel;
+}
+
+/**
+ * @brief Copia o estado publicado (lado leitor do seqlock).
+ * Repete a cópia se o jogo escreveu no meio dela, dormindo 1 ms entre
+ * tentativas. Desiste se o jogo terminar, morrer ou se a escrita não
+ * acabar em MAX_TENTATIVAS.
+ * Retorna 1 e o número de sequência da cópia em 'sequencia', ou 0.
+ */
+int lerEstado(PainelCompartilhado *painel, EstadoPublicado *copia, unsigned int *sequencia) {
+    for (int tentativa = 0; tentativa < MAX_TENTATIVAS; tentativa++) {
+        if (!atomic_load(&painel->ativo) || !jogoVivo(painel)) return 0;
+
+        unsigned int antes = atomic_load_explicit(&painel->sequencia, memory_order_acquire);
+        if (antes & 1) { // Escrita em andamento
+            dormirMs(1);
+            continue;
+        }
+
+        memcpy(&copia->visao, &painel->visao, sizeof(VisaoEstado));
+        copia->proximoId = painel->proximoId;
+        copia->stats = painel->stats;
+
+        atomic_thread_fence(memory_order_acquire);
+        unsigned int depois = atomic_load_explicit(&painel->sequencia, memory_order_relaxed);
+        if (antes == depois) {
+            *sequencia = antes;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+// -----------------------------------------------------------------
+// 3. FUNÇÕES DE EXIBIÇÃO
+// -----------------------------------------------------------------
+
+void visualizarFila(VisaoEstado *visao) {
+    printf("Fila de Pecas: ");
+    if (visao->countFila == 0) {
+        printf("[VAZIA]");
+    } else {
+        int visiveis = visao->countFila < JANELA_FILA ? visao->countFila : JANELA_FILA;
+        for (int i = 0; i < visiveis; i++) {
+            printf("[%c %d] ", visao->frenteFila[i].nome, visao->frenteFila[i].id);
+        }
+        if (visao->countFila > visiveis) printf("... (+%d)", visao->countFila - visiveis);
+    }
+    printf("\n");
+}
+
+void visualizarPilha(PilhaLinear *pilha) {
+    printf("Pilha de Reserva (Topo -> Base): ");
+    if (pilha->topo == -1) {
+        printf("[VAZIA]");
+    } else {
+        for (int i = pilha->topo; i >= 0; i--) {
+            printf("[%c %d] ", pilha->itens[i].nome, pilha->itens[i].id);
+        }
+    }
+    printf("\n");
+}
+
+
+// -----------------------------------------------------------------
+// 4. FUNÇÃO PRINCIPAL (MAIN)
+// -----------------------------------------------------------------
+
+int main() {
+    PainelCompartilhado *painel = abrirPainel();
+    if (painel == NULL) return 1;
+
+    EstadoPublicado estado;
+    unsigned int ultimaSequencia = 0;
+    unsigned int sequencia;
+
+    printf("Acompanhando a partida (Ctrl+C para sair)...\n");
+    while (lerEstado(painel, &estado, &sequencia)) {
+        // Só mostra quando o jogo publicou algo novo
+        if (sequencia != ultimaSequencia) {
+            printf("\n=== Espectador ===\n");
+            visualizarFila(&estado.visao);
+            visualizarPilha(&estado.visao.pilha);
+            printf("Pecas jogadas: %d\n", estado.stats.pecasJogadas);
+            fflush(stdout);
+            ultimaSequencia = sequencia;
+        }
+        dormirMs(INTERVALO_MS);
+    }
+
+    if (!atomic_load(&painel->ativo)) {
+        printf("\nPartida encerrada.\n");
+    } else if (!jogoVivo(painel)) {
+        printf("\n>> ERRO: O jogo terminou sem fechar o painel.\n");
+    } else {
+        printf("\n>> ERRO: O jogo parou no meio de uma publicacao.\n");
+    }
+    munmap(painel, sizeof(PainelCompartilhado));
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <ctype.h>
+#include <unistd.h>
 
 // -----------------------------------------------------------------
 // 1. DEFINIÇÕES E ESTRUTURAS
@@ -151,6 +153,39 @@ void exibirMenu() {
     printf("Escolha uma opcao: ");
 }
 
+/**
+ * @brief Lê a opção do menu (substitui o scanf("%d")).
+ * Tokenizador simples sobre getchar(): pula espaços, lê um inteiro e
+ * devolve o caractere seguinte para a entrada. Se o token não começar
+ * com um número, descarta o resto da linha e devolve -1 (opção
+ * inválida), como antes. No fim da entrada devolve 0 (Sair).
+ */
+int lerOpcao() {
+    int c;
+    do {
+        c = getchar();
+    } while (isspace(c));
+    if (c == EOF) return 0;
+
+    int sinal = 1;
+    if (c == '-' || c == '+') {
+        if (c == '-') sinal = -1;
+        c = getchar();
+    }
+    if (!isdigit(c)) {
+        while (c != '\n' && c != EOF) c = getchar(); // Limpa buffer
+        return -1;
+    }
+
+    int valor = 0;
+    while (isdigit(c)) {
+        if (valor < 100000) valor = valor * 10 + (c - '0'); // Evita overflow
+        c = getchar();
+    }
+    ungetc(c, stdin); // Deixa o resto para a próxima leitura
+    return sinal * valor;
+}
+
 /**
  * @brief Inicializa a fila com 5 peças automáticas, conforme requisito.
  */
@@ -178,6 +213,10 @@ int main() {
     // Inicializa o gerador de números aleatórios
     srand(time(NULL));
 
+    // Se a entrada vier de um pipe ou arquivo (sessão gravada),
+    // lê em blocos grandes de 64 KB em vez de linha a linha
+    if (!isatty(fileno(stdin))) setvbuf(stdin, NULL, _IOFBF, 1 << 16);
+
     FilaCircular filaDePecas;
     inicializarFila(&filaDePecas);
 
@@ -191,11 +230,8 @@ int main() {
         exibirMenu();
 
         // 3. Lê a opção do usuário
-        if (scanf("%d", &opcao) != 1) {
-            // Limpa o buffer de entrada em caso de erro (ex: digitou uma letra)
-            while(getchar() != '\n');
-            opcao = -1; // Força uma opção inválida
-        }
+        // (lerOpcao devolve -1 se o usuário digitou algo inválido)
+        opcao = lerOpcao();
 
         // 4. Executa a ação
         switch (opcao) {